@@ -1,3 +1,4 @@
+#include <fat.h>
 #include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,11 +7,30 @@
 #include <ogc/lwp_watchdog.h>
 #include <wiiuse/wpad.h>
 
+#include "modeutil.h"
+#include "stress.h"
+#include "trace.h"
+#include "xfb.h"
+
 #define FIFO_SIZE (256*1024)
 #define STATE_GEOMETRY 1
 #define STATE_TEXT 2
+#define RENDER_GX 0
+#define RENDER_CPU 1
+#define RENDER_CPU_PS 2
+#define NUM_RENDER_PATHS 3
+#define PRESETS_FILE "sd:/wii-screen-presets.txt"
+#define MAX_PRESETS 32
+#define BENCHMARK_INTERVAL 60
 
 static void *xfb = NULL;
+static void *xfbs[2];
+static u32 xfb_size;
+static int xfb_index = 0;
+static u32 current_field = 0;
+static u32 marker_line = 0;
+static bool sd_ready = false;
+static char status_message[64] = "";
 static GXRModeObj rmode, nextmode;
 static sys_fontheader *fontdata;
 static GXTexObj fonttex;
@@ -20,16 +40,32 @@ static int text_y;
 static int font_size;
 static u32 text_color = 0xffffffff;
 static int active_control = 0;
+static struct stress_config stress = { STRESS_OFF, 4, 10 };
+static int render_path = RENDER_GX;
+static u32 render_usec[NUM_RENDER_PATHS];
+
+static struct _preset {
+    char name[MODE_PRESET_NAME_SIZE];
+    GXRModeObj mode;
+} presets[MAX_PRESETS];
+static int num_presets = 0;
+static int preset_index = 0;
 
 static void format_value_u16(char *buffer, void *data);
 static void format_value_videomode(char *buffer, void *data);
 static void format_value_tvmode(char *buffer, void *data);
 static void format_value_xfbmode(char *buffer, void *data);
+static void format_value_stress(char *buffer, void *data);
+static void format_value_bool(char *buffer, void *data);
+static void format_value_preset(char *buffer, void *data);
 
 static void change_value_u16(u32 pressed, u32 held, void *data);
 static void change_value_videomode(u32 pressed, u32 held, void *data);
 static void change_value_tvmode(u32 pressed, u32 held, void *data);
 static void change_value_xfbmode(u32 pressed, u32 held, void *data);
+static void change_value_stress(u32 pressed, u32 held, void *data);
+static void change_value_field_rendering(u32 pressed, u32 held, void *data);
+static void change_value_preset(u32 pressed, u32 held, void *data);
 
 const static struct _control {
     int x;
@@ -40,15 +76,20 @@ const static struct _control {
     void *data;
 } controls[] = {
     { 200, 0, "Video mode: ", format_value_videomode, change_value_videomode, &nextmode, },
+    { 200, 20, "Preset: ", format_value_preset, change_value_preset, &preset_index, },
     { 200, 40, "TV mode: ", format_value_tvmode, change_value_tvmode, &nextmode.viTVMode, },
     { 60, 60, "FB width: ", format_value_u16, change_value_u16, &nextmode.fbWidth, },
     { 60, 80, "XFB mode: ", format_value_xfbmode, change_value_xfbmode, &nextmode.xfbMode, },
     { 360, 60, "EFB height: ", format_value_u16, change_value_u16, &nextmode.efbHeight, },
     { 360, 80, "XFB height: ", format_value_u16, change_value_u16, &nextmode.xfbHeight, },
+    { 60, 100, "Field rendering: ", format_value_bool, change_value_field_rendering, &nextmode.field_rendering, },
     { 60, 120, "VI width: ", format_value_u16, change_value_u16, &nextmode.viWidth, },
     { 360, 120, "VI height: ", format_value_u16, change_value_u16, &nextmode.viHeight, },
     { 60, 140, "VI X origin: ", format_value_u16, change_value_u16, &nextmode.viXOrigin, },
     { 360, 140, "VI Y origin: ", format_value_u16, change_value_u16, &nextmode.viYOrigin, },
+    { 60, 180, "Stress: ", format_value_stress, change_value_stress, &stress.mode, },
+    { 360, 180, "Quad layers: ", format_value_u16, change_value_u16, &stress.layers, },
+    { 360, 200, "Triangles (k): ", format_value_u16, change_value_u16, &stress.ktriangles, },
 };
 #define NUM_CONTROLS (sizeof(controls) / sizeof(struct _control))
 
@@ -133,6 +174,13 @@ const static struct _control_label xfbmode_labels[] = {
 
 #undef LABEL
 
+const static struct _control_label stress_labels[] = {
+    { STRESS_OFF, "Off" },
+    { STRESS_FIXED, "Fixed load" },
+    { STRESS_RAMP, "Ramp" },
+};
+#define NUM_STRESS_MODES (sizeof(stress_labels) / sizeof(struct _control_label))
+
 static inline void set_text_pos(int x, int y)
 {
     text_x = x;
@@ -252,6 +300,31 @@ static void format_value_xfbmode(char *buffer, void *data)
     }
 }
 
+static void format_value_stress(char *buffer, void *data)
+{
+    u32 mode = *(u32*)data;
+
+    strcpy(buffer, label_from_value(stress_labels, NUM_STRESS_MODES, mode));
+}
+
+static void format_value_bool(char *buffer, void *data)
+{
+    strcpy(buffer, *(u8*)data ? "On" : "Off");
+}
+
+static void format_value_preset(char *buffer, void *data)
+{
+    int index = *(int*)data;
+
+    if (num_presets == 0) {
+        strcpy(buffer, "None");
+    } else if (memcmp(&presets[index].mode, &nextmode, sizeof(GXRModeObj)) == 0) {
+        strcpy(buffer, presets[index].name);
+    } else {
+        strcpy(buffer, "-");
+    }
+}
+
 static void change_value_u16(u32 pressed, u32 held, void *data)
 {
     u16 *value = (u16*)data;
@@ -315,6 +388,65 @@ static void change_value_xfbmode(u32 pressed, u32 held, void *data)
     change_value_label(xfbmode_labels, NUM_XFBMODES, pressed, held, data);
 }
 
+static void change_value_preset(u32 pressed, u32 held, void *data)
+{
+    int *index = data;
+
+    if (num_presets == 0) return;
+
+    if (memcmp(&presets[*index].mode, &nextmode, sizeof(GXRModeObj)) != 0) {
+        /* The first press selects the current preset again */
+        if (!(pressed & (WPAD_BUTTON_LEFT | WPAD_BUTTON_RIGHT))) return;
+    } else if (pressed & WPAD_BUTTON_RIGHT) {
+        if (*index < num_presets - 1) (*index)++;
+    } else if (pressed & WPAD_BUTTON_LEFT) {
+        if (*index > 0) (*index)--;
+    } else {
+        return;
+    }
+
+    memcpy(&nextmode, &presets[*index].mode, sizeof(GXRModeObj));
+}
+
+static void change_value_stress(u32 pressed, u32 held, void *data)
+{
+    change_value_label(stress_labels, NUM_STRESS_MODES, pressed, held, data);
+}
+
+/*
+ * Field rendering draws each field separately at half height into a
+ * single-field XFB, which the VI shows line-doubled; the viewport is offset
+ * by half a line on alternate fields. Only meaningful for interlaced modes.
+ */
+static void change_value_field_rendering(u32 pressed, u32 held, void *data)
+{
+    GXRModeObj *mode = &nextmode;
+    static u16 frame_efb_height = 0;
+    u16 max_efb_height;
+
+    if (!(pressed & (WPAD_BUTTON_LEFT | WPAD_BUTTON_RIGHT))) return;
+    if ((mode->viTVMode & 3) != VI_INTERLACE) return;
+
+    if (!mode->field_rendering) {
+        frame_efb_height = mode->efbHeight;
+        mode->field_rendering = GX_TRUE;
+        mode->xfbMode = VI_XFBMODE_SF;
+        mode->xfbHeight = mode->viHeight / 2;
+        mode->efbHeight = mode->xfbHeight;
+    } else {
+        mode->field_rendering = GX_FALSE;
+        mode->xfbMode = VI_XFBMODE_DF;
+        mode->xfbHeight = mode->viHeight;
+        // Anti-aliased modes have a half-height EFB
+        max_efb_height = mode->aa ? MODE_EFB_MAX_HEIGHT_AA : MODE_EFB_MAX_HEIGHT;
+        if (frame_efb_height == 0 || frame_efb_height > mode->viHeight) {
+            frame_efb_height = mode->viHeight;
+        }
+        mode->efbHeight = frame_efb_height < max_efb_height ?
+            frame_efb_height : max_efb_height;
+    }
+}
+
 static void activate_font_texture()
 {
     u32 texture_size;
@@ -455,6 +587,18 @@ static void setup_viewport()
     GX_SetDispCopySrc(0, 0, w, h);
     GX_SetDispCopyDst(w, rmode.xfbHeight);
     GX_SetCopyFilter(rmode.aa, rmode.sample_pattern, GX_TRUE, rmode.vfilter);
+    GX_SetFieldMode(rmode.field_rendering,
+                    rmode.viHeight == 2 * rmode.xfbHeight ? GX_ENABLE : GX_DISABLE);
+}
+
+static void setup_field_viewport()
+{
+    u32 w, h;
+
+    w = rmode.fbWidth;
+    h = rmode.efbHeight;
+
+    GX_SetViewportJitter(0, 0, w, h, 0, 1, current_field);
 }
 
 static int process_string(const char *text, int should_draw)
@@ -488,25 +632,55 @@ static int string_width(const char *text)
     return process_string(text, 0);
 }
 
+/*
+ * The controls block spans CONTROLS_HEIGHT lines, from the top of the first
+ * row to the baseline of the last one, and must stay above the two help
+ * lines. On short EFBs (such as 240-line modes) it is shrunk to fit.
+ */
+#define CONTROLS_HEIGHT 300
+#define HELP_HEIGHT 50
+
+static int controls_space()
+{
+    return rmode.efbHeight - HELP_HEIGHT;
+}
+
+/* Converts a row offset of the controls block into an EFB line */
+static int controls_y(int y)
+{
+    int space = controls_space();
+
+    if (space >= CONTROLS_HEIGHT) {
+        return (space - CONTROLS_HEIGHT) / 2 + 20 + y;
+    }
+    return (20 + y) * space / CONTROLS_HEIGHT;
+}
+
+static int controls_text_size(int size)
+{
+    int space = controls_space();
+
+    if (space >= CONTROLS_HEIGHT) return size;
+    return size * space / CONTROLS_HEIGHT;
+}
+
 static void draw_controls()
 {
     char buffer[64];
 
-    int h = rmode.efbHeight;
-    int base_y = (h - 160) / 2;
     for (int i = 0; i < NUM_CONTROLS; i++) {
         const struct _control *ctrl = &controls[i];
         int x, y;
 
         x = ctrl->x;
-        y = base_y + ctrl->y;
+        y = controls_y(ctrl->y);
         if (i == active_control) {
             set_text_color(0xffff00ff);
         } else {
             set_text_color(0xffffffff);
         }
         set_text_pos(x, y);
-        set_text_size(18);
+        set_text_size(controls_text_size(18));
         if (ctrl->label) {
             x += draw_string(ctrl->label);
             set_text_pos(x, y);
@@ -586,6 +760,75 @@ static void draw_help()
     set_text_pos(x, y);
     set_text_color(0xffffffff);
     x += draw_string(" - Reset");
+
+    y -= 20;
+    x = w / 4;
+    set_text_pos(x, y);
+    set_text_color(0x00c0ffff);
+    x += draw_string("+");
+    set_text_pos(x, y);
+    set_text_color(0xffffffff);
+    x += draw_string(" - Save trace");
+
+    x += 40;
+    set_text_pos(x, y);
+    set_text_color(0xc0c0c0ff);
+    x += draw_string("B");
+    set_text_pos(x, y);
+    set_text_color(0xffffffff);
+    x += draw_string(" - Render path");
+}
+
+static void draw_stress_status()
+{
+    char buffer[80];
+
+    set_text_size(controls_text_size(16));
+    set_text_color(0xff8000ff);
+
+    stress_format_status(buffer, &stress, rmode.fbWidth, rmode.efbHeight);
+    set_text_pos(60, controls_y(220));
+    draw_string(buffer);
+
+    stress_format_result(buffer, rmode.fbWidth, rmode.efbHeight);
+    set_text_pos(60, controls_y(240));
+    draw_string(buffer);
+}
+
+static void draw_benchmark()
+{
+    char buffer[80];
+
+    sprintf(buffer, "Grid time: GX %u us, CPU %u us, CPU+ps clear %u us",
+            render_usec[RENDER_GX], render_usec[RENDER_CPU],
+            render_usec[RENDER_CPU_PS]);
+    set_text_size(controls_text_size(16));
+    set_text_color(0x80ff80ff);
+    set_text_pos(60, controls_y(260));
+    draw_string(buffer);
+}
+
+static void draw_mode_check()
+{
+    char buffer[80];
+    const char *error;
+
+    error = mode_check(&nextmode);
+    if (!error) return;
+
+    sprintf(buffer, "Invalid mode: %s", error);
+    set_text_size(controls_text_size(16));
+    set_text_color(0xff4040ff);
+    set_text_pos(60, controls_y(160));
+    draw_string(buffer);
+}
+
+static void draw_status_message()
+{
+    set_text_size(controls_text_size(16));
+    set_text_color(0x00c0ffff);
+    set_text_pos(60, controls_y(280));
+    draw_string(status_message);
 }
 
 static void draw_text()
@@ -593,6 +836,10 @@ static void draw_text()
     draw_corner_labels();
     draw_help();
     draw_controls();
+    draw_mode_check();
+    draw_stress_status();
+    draw_benchmark();
+    draw_status_message();
 }
 
 static void draw_line(int x0, int y0, int x1, int y1)
@@ -607,6 +854,43 @@ static void draw_line(int x0, int y0, int x1, int y1)
     GX_End();
 }
 
+/*
+ * A one-line stripe which moves down by one frame line every field: it is
+ * drawn on EFB line marker_line / 2, and the viewport jitter places it on
+ * the frame line of the current field's parity. If the parity reported by
+ * VIDEO_GetNextField() matches the field actually shown, the stripe crawls
+ * smoothly; if it is swapped, the stripe for frame line m lands on m + 1
+ * for even m and m - 1 for odd m (1, 0, 3, 2, 5, ...), so it moves up one
+ * line, then down three.
+ */
+static void draw_field_marker(int w, int h)
+{
+    int x = w / 2 - 32;
+    int y = marker_line / 2;
+
+    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+    GX_Position2s16(x, y);
+    GX_Color1u32(0xff8000ff);
+    GX_Position2s16(x + 64, y);
+    GX_Color1u32(0xff8000ff);
+    GX_Position2s16(x + 64, y + 1);
+    GX_Color1u32(0xff8000ff);
+    GX_Position2s16(x, y + 1);
+    GX_Color1u32(0xff8000ff);
+    GX_End();
+}
+
+/* The upper field holds the even frame lines */
+static void advance_field_marker()
+{
+    u32 parity = current_field == VI_FIELD_ABOVE ? 0 : 1;
+
+    marker_line++;
+    // Resynchronise after a dropped field
+    if ((marker_line & 1) != parity) marker_line++;
+    marker_line %= 2 * rmode.efbHeight;
+}
+
 static void draw_background()
 {
     u32 w, h;
@@ -627,22 +911,132 @@ static void draw_background()
     // Diagonal lines
     draw_line(0, 0, w, h);
     draw_line(w, 0, 0, h);
+
+    if (rmode.field_rendering) {
+        draw_field_marker(w, h);
+    }
+}
+
+/*
+ * Times GX producing the grid in an XFB, from the first vertex to the end
+ * of the EFB to XFB copy, like the CPU paths do. The copy goes to the XFB
+ * which is not being shown, and clears the EFB for the real frame.
+ */
+static void benchmark_gx()
+{
+    void *target = rmode.field_rendering ? xfb : xfbs[xfb_index ^ 1];
+    u64 start = gettime();
+
+    trace_begin(TRACE_BENCHMARK);
+    set_drawing_state(STATE_GEOMETRY);
+    draw_background();
+    GX_CopyDisp(target, GX_TRUE);
+    GX_DrawDone();
+    trace_end(TRACE_BENCHMARK);
+    render_usec[RENDER_GX] = diff_usec(start, gettime());
+}
+
+static void render_gx()
+{
+    static u32 frames = 0;
+
+    if (rmode.field_rendering) setup_field_viewport();
+
+    // This stalls the pipeline, so do it only once a second and never while
+    // the stress ramp is measuring
+    if (frames++ % BENCHMARK_INTERVAL == 0 && stress.mode != STRESS_RAMP) {
+        benchmark_gx();
+    }
+
+    trace_begin(TRACE_DRAW_BACKGROUND);
+    set_drawing_state(STATE_GEOMETRY);
+    draw_background();
+    GX_SetDrawSync(TRACE_DRAW_BACKGROUND);
+    trace_end(TRACE_DRAW_BACKGROUND);
+
+    stress_draw(&stress, rmode.fbWidth, rmode.efbHeight);
+
+    trace_begin(TRACE_DRAW_TEXT);
+    set_drawing_state(STATE_TEXT);
+    draw_text();
+    GX_SetDrawSync(TRACE_DRAW_TEXT);
+    trace_end(TRACE_DRAW_TEXT);
+
+    trace_begin(TRACE_DRAW_DONE);
+    GX_DrawDone();
+    trace_end(TRACE_DRAW_DONE);
+
+    trace_begin(TRACE_COPY_DISP);
+    GX_CopyDisp(xfb, GX_TRUE);
+    GX_Flush();
+    trace_end(TRACE_COPY_DISP);
+}
+
+/* Writes the grid straight into the XFB, without any help from GX */
+static void render_cpu(bool paired_single)
+{
+    u64 start = gettime();
+
+    trace_begin(TRACE_XFB_PATTERN);
+    xfb_draw_pattern(xfb, xfb_size, &rmode, paired_single);
+    trace_end(TRACE_XFB_PATTERN);
+    render_usec[paired_single ? RENDER_CPU_PS : RENDER_CPU] =
+        diff_usec(start, gettime());
+}
+
+static void render_frame()
+{
+    if (rmode.field_rendering) {
+        current_field = VIDEO_GetNextField();
+        trace_instant(TRACE_FIELD, current_field);
+        advance_field_marker();
+    }
+
+    if (render_path == RENDER_GX) {
+        render_gx();
+    } else {
+        render_cpu(render_path == RENDER_CPU_PS);
+    }
+
+    if (rmode.field_rendering) {
+        // Show the new field at the next retrace, while drawing the other one
+        VIDEO_SetNextFramebuffer(xfb);
+        VIDEO_Flush();
+        xfb_index ^= 1;
+        xfb = xfbs[xfb_index];
+    }
 }
 
 static void apply_settings()
 {
+    trace_begin(TRACE_APPLY_SETTINGS);
     memcpy(&rmode, &nextmode, sizeof(nextmode));
 
+    trace_begin(TRACE_VIDEO_CONFIGURE);
     VIDEO_SetBlack(TRUE);
     VIDEO_Configure(&rmode);
+    xfb_index = 0;
+    xfb = xfbs[xfb_index];
+    VIDEO_SetNextFramebuffer(xfb);
     VIDEO_SetBlack(FALSE);
+    trace_end(TRACE_VIDEO_CONFIGURE);
 
+    trace_begin(TRACE_VIDEO_FLUSH);
     VIDEO_Flush();
+    trace_end(TRACE_VIDEO_FLUSH);
 
+    trace_begin(TRACE_SETTLE_VSYNC);
     VIDEO_WaitVSync();
     if (rmode.viTVMode&VI_NON_INTERLACE) VIDEO_WaitVSync();
+    trace_end(TRACE_SETTLE_VSYNC);
 
+    trace_begin(TRACE_SETUP_VIEWPORT);
     setup_viewport();
+    trace_end(TRACE_SETUP_VIEWPORT);
+
+    // Throughput measured in the previous mode does not apply anymore
+    stress_reset();
+    trace_end(TRACE_APPLY_SETTINGS);
 }
 
 static void reset_settings()
@@ -656,22 +1050,7 @@ static void toggle_widescreen()
     int max_width;
 
     widescreen = !widescreen;
-    switch (nextmode.viTVMode >> 2) {
-    case VI_DEBUG:
-    case VI_NTSC:
-        max_width = VI_MAX_WIDTH_NTSC;
-        break;
-    case VI_DEBUG_PAL:
-    case VI_PAL:
-        max_width = VI_MAX_WIDTH_PAL;
-        break;
-    case VI_MPAL:
-        max_width = VI_MAX_WIDTH_MPAL;
-        break;
-    case VI_EURGB60:
-        max_width = VI_MAX_WIDTH_EURGB60;
-        break;
-    }
+    max_width = mode_max_width(nextmode.viTVMode);
     if (widescreen) {
         nextmode.viWidth = 678;
     } else {
@@ -680,9 +1059,52 @@ static void toggle_widescreen()
     nextmode.viXOrigin = (max_width - nextmode.viWidth) / 2;
 }
 
+/*
+ * Reads the presets written by tools/modesolver. The copy filter settings
+ * are not part of a preset, so they are taken from the given mode.
+ */
+static void load_presets(const GXRModeObj *base)
+{
+    char line[256];
+    FILE *file;
+
+    file = fopen(PRESETS_FILE, "r");
+    if (!file) return;
+
+    while (num_presets < MAX_PRESETS && fgets(line, sizeof(line), file)) {
+        struct _preset *preset = &presets[num_presets];
+
+        memcpy(&preset->mode, base, sizeof(GXRModeObj));
+        if (mode_parse_preset(line, preset->name, &preset->mode) == 0 &&
+            mode_check(&preset->mode) == NULL) {
+            num_presets++;
+        }
+    }
+    fclose(file);
+}
+
+static void save_trace()
+{
+    int index;
+
+    if (!sd_ready) {
+        strcpy(status_message, "SD not available, trace not saved");
+        return;
+    }
+
+    index = trace_flush();
+    if (index < 0) {
+        strcpy(status_message, "Could not save the trace");
+    } else {
+        sprintf(status_message, "Trace saved as " TRACE_FILE_FORMAT, index);
+    }
+}
+
 int main(int argc, char **argv)
 {
     const GXRModeObj *vmode;
+    GXRModeObj xfbmode;
+    u32 frame = 0, retrace_count, last_retrace_count;
 
     // Initialise the video system
     VIDEO_Init();
@@ -697,7 +1119,15 @@ int main(int argc, char **argv)
     memcpy(&nextmode, vmode, sizeof(nextmode));
 
     // Allocate memory for the display in the uncached region
-    xfb = MEM_K0_TO_K1(SYS_AllocateFramebuffer(&rmode));
+    // The second one is used for field rendering and for timing GX. Both are
+    // sized for the largest mode, since the mode can be changed at runtime
+    memcpy(&xfbmode, &rmode, sizeof(xfbmode));
+    xfbmode.fbWidth = XFB_MAX_WIDTH;
+    xfbmode.xfbHeight = XFB_MAX_HEIGHT;
+    xfb_size = VIDEO_PadFramebufferWidth(XFB_MAX_WIDTH) * XFB_MAX_HEIGHT * 2;
+    xfbs[0] = MEM_K0_TO_K1(SYS_AllocateFramebuffer(&xfbmode));
+    xfbs[1] = MEM_K0_TO_K1(SYS_AllocateFramebuffer(&xfbmode));
+    xfb = xfbs[0];
 
     // Set up the video registers with the chosen mode
     VIDEO_Configure(&rmode);
@@ -719,7 +1149,14 @@ int main(int argc, char **argv)
     setup_font();
     setup_viewport();
 
+    sd_ready = fatInitDefault();
+    trace_init();
+    load_presets(vmode);
+    last_retrace_count = VIDEO_GetRetraceCount();
+
     while (1) {
+        trace_record(TRACE_FRAME, TRACE_PHASE_BEGIN, frame);
+        trace_begin(TRACE_INPUT);
 
         // Call WPAD_ScanPads each loop, this reads the latest controller states
         WPAD_ScanPads();
@@ -730,7 +1167,10 @@ int main(int argc, char **argv)
         u32 held = WPAD_ButtonsHeld(0);
 
         // We return to the launcher application via exit
-        if (pressed & WPAD_BUTTON_HOME) exit(0);
+        if (pressed & WPAD_BUTTON_HOME) {
+            if (sd_ready) trace_flush();
+            exit(0);
+        }
 
         if (pressed & WPAD_BUTTON_UP) {
             active_control--;
@@ -742,23 +1182,31 @@ int main(int argc, char **argv)
             reset_settings();
         } else if (pressed & WPAD_BUTTON_A) {
             toggle_widescreen();
+        } else if (pressed & WPAD_BUTTON_PLUS) {
+            save_trace();
+        } else if (pressed & WPAD_BUTTON_B) {
+            render_path = (render_path + 1) % NUM_RENDER_PATHS;
+            // The stress load is only drawn by GX
+            stress_restart_level();
         }
         active_control %= NUM_CONTROLS;
 
         change_active_control(pressed, held);
+        trace_end(TRACE_INPUT);
 
-        set_drawing_state(STATE_GEOMETRY);
-        draw_background();
-
-        set_drawing_state(STATE_TEXT);
-        draw_text();
-
-        GX_DrawDone();
-        GX_CopyDisp(xfb, GX_TRUE);
-        GX_Flush();
+        render_frame();
 
         // Wait for the next frame
+        trace_begin(TRACE_WAIT_VSYNC);
         VIDEO_WaitVSync();
+        trace_end(TRACE_WAIT_VSYNC);
+        trace_record(TRACE_FRAME, TRACE_PHASE_END, frame++);
+
+        retrace_count = VIDEO_GetRetraceCount();
+        if (render_path == RENDER_GX) {
+            stress_frame_done(&stress, retrace_count - last_retrace_count);
+        }
+        last_retrace_count = retrace_count;
     }
 
     return 0;
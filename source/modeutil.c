@@ -0,0 +1,149 @@
+#include <stdio.h>
+
+#include "modeutil.h"
+
+u16 mode_max_width(u32 tvmode)
+{
+    switch (tvmode >> 2) {
+    case VI_PAL:
+    case VI_DEBUG_PAL:
+        return VI_MAX_WIDTH_PAL;
+    case VI_MPAL:
+        return VI_MAX_WIDTH_MPAL;
+    case VI_EURGB60:
+        return VI_MAX_WIDTH_EURGB60;
+    default:
+        return VI_MAX_WIDTH_NTSC;
+    }
+}
+
+/* Height of the area libogc centres its stock modes in */
+static u16 vi_height(u32 tvmode)
+{
+    switch (tvmode >> 2) {
+    case VI_PAL:
+    case VI_DEBUG_PAL:
+        return VI_MAX_HEIGHT_PAL;
+    case VI_MPAL:
+        return VI_MAX_HEIGHT_MPAL;
+    case VI_EURGB60:
+        return VI_MAX_HEIGHT_EURGB60;
+    default:
+        return VI_MAX_HEIGHT_NTSC;
+    }
+}
+
+/* PAL has 576 active lines, one more at each edge than VI_MAX_HEIGHT_PAL */
+u16 mode_max_height(u32 tvmode)
+{
+    switch (tvmode >> 2) {
+    case VI_PAL:
+    case VI_DEBUG_PAL:
+        return MODE_MAX_HEIGHT_PAL;
+    default:
+        return vi_height(tvmode);
+    }
+}
+
+/* Same formula as libogc, so a 576-line PAL mode gets a Y origin of -1 */
+void mode_center(GXRModeObj *mode)
+{
+    mode->viXOrigin = (mode_max_width(mode->viTVMode) - mode->viWidth) / 2;
+    mode->viYOrigin = (vi_height(mode->viTVMode) - mode->viHeight) / 2;
+}
+
+/* Returns NULL if the mode can be displayed, or the reason why not */
+const char *mode_check(const GXRModeObj *mode)
+{
+    u32 scan = mode->viTVMode & 3;
+    s16 y_origin = (s16)mode->viYOrigin;
+    s32 y_margin;
+
+    if ((mode->viTVMode >> 2) > VI_EURGB60 || scan > VI_PROGRESSIVE)
+        return "unknown TV mode";
+
+    if (mode->fbWidth == 0 || mode->fbWidth > MODE_FB_MAX_WIDTH ||
+        mode->fbWidth % 16 != 0)
+        return "FB width must be a multiple of 16 up to 640";
+    if (mode->efbHeight == 0 || mode->efbHeight > MODE_EFB_MAX_HEIGHT)
+        return "EFB height must be between 1 and 528";
+    if (mode->aa && mode->efbHeight > MODE_EFB_MAX_HEIGHT_AA)
+        return "anti-aliased EFB height must be up to 264";
+    if (mode->xfbHeight < mode->efbHeight)
+        return "XFB height is smaller than the EFB";
+
+    if (mode->viWidth < mode->fbWidth)
+        return "VI width is smaller than the FB";
+    if (mode->viXOrigin + mode->viWidth > mode_max_width(mode->viTVMode))
+        return "VI width and X origin exceed the screen";
+    if (mode->viHeight % 2 != 0)
+        return "VI height must be even";
+    /* The Y origin is signed, relative to libogc's centring area */
+    y_margin = (mode_max_height(mode->viTVMode) - vi_height(mode->viTVMode)) / 2;
+    if (y_origin < -y_margin)
+        return "VI Y origin is above the screen";
+    if (y_origin + mode->viHeight > vi_height(mode->viTVMode) + y_margin)
+        return "VI height and Y origin exceed the screen";
+
+    if (mode->xfbMode == VI_XFBMODE_DF) {
+        if (scan != VI_INTERLACE)
+            return "double-field XFB needs an interlaced mode";
+        if (mode->viHeight != mode->xfbHeight)
+            return "double-field XFB height must match the VI height";
+    } else if (mode->xfbMode == VI_XFBMODE_SF) {
+        u16 lines = scan == VI_PROGRESSIVE ? mode->viHeight : mode->viHeight / 2;
+        if (mode->xfbHeight != lines)
+            return "single-field XFB height does not match the VI height";
+    } else {
+        return "unknown XFB mode";
+    }
+
+    if (mode->field_rendering &&
+        (scan != VI_INTERLACE || mode->xfbMode != VI_XFBMODE_SF))
+        return "field rendering needs an interlaced single-field XFB";
+
+    return NULL;
+}
+
+/*
+ * Presets are stored one per line as the name followed by the TV mode,
+ * FB width, EFB height, XFB height, VI X and Y origin, VI width and height,
+ * XFB mode and field rendering flag. Lines starting with '#' are comments.
+ */
+int mode_format_preset(char *buffer, size_t size, const char *name,
+                       const GXRModeObj *mode)
+{
+    return snprintf(buffer, size, "%s %u %u %u %u %u %u %u %u %u %u\n", name,
+                    (unsigned)mode->viTVMode, mode->fbWidth, mode->efbHeight,
+                    mode->xfbHeight, mode->viXOrigin, mode->viYOrigin,
+                    mode->viWidth, mode->viHeight, (unsigned)mode->xfbMode,
+                    mode->field_rendering);
+}
+
+/*
+ * Only the fields listed above are set: the copy filter settings are left
+ * untouched. name must hold MODE_PRESET_NAME_SIZE bytes. Returns 0 on
+ * success.
+ */
+int mode_parse_preset(const char *line, char *name, GXRModeObj *mode)
+{
+    unsigned int v[10];
+    int n;
+
+    n = sscanf(line, "%31s %u %u %u %u %u %u %u %u %u %u", name,
+               &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7],
+               &v[8], &v[9]);
+    if (n != 11 || name[0] == '#') return -1;
+
+    mode->viTVMode = v[0];
+    mode->fbWidth = v[1];
+    mode->efbHeight = v[2];
+    mode->xfbHeight = v[3];
+    mode->viXOrigin = v[4];
+    mode->viYOrigin = v[5];
+    mode->viWidth = v[6];
+    mode->viHeight = v[7];
+    mode->xfbMode = v[8];
+    mode->field_rendering = v[9];
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef WII_SCREEN_MODEUTIL_H
+#define WII_SCREEN_MODEUTIL_H
+
+/*
+ * Video mode logic shared by the console program and the host-side tools.
+ * It must not call into libogc, only use its types and constants.
+ */
+
+#include <stddef.h>
+
+#ifdef GEKKO
+#include <gccore.h>
+#else
+#include "ogc_host.h"
+#endif
+
+#define MODE_EFB_MAX_HEIGHT 528
+#define MODE_EFB_MAX_HEIGHT_AA 264
+#define MODE_FB_MAX_WIDTH 640
+#define MODE_MAX_HEIGHT_PAL 576
+#define MODE_PRESET_NAME_SIZE 32
+
+u16 mode_max_width(u32 tvmode);
+u16 mode_max_height(u32 tvmode);
+void mode_center(GXRModeObj *mode);
+const char *mode_check(const GXRModeObj *mode);
+
+int mode_format_preset(char *buffer, size_t size, const char *name,
+                       const GXRModeObj *mode);
+int mode_parse_preset(const char *line, char *name, GXRModeObj *mode);
+
+#endif
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "stress.h"
+#include "trace.h"
+
+#define WARMUP_FRAMES 4
+#define HOLD_FRAMES 60
+#define MAX_MISSED 3
+#define MAX_LAYERS 1024
+#define MAX_KTRIANGLES 2048
+#define TRIANGLE_SIZE 8
+#define TRIANGLES_PER_BATCH 1024
+
+#define RAMP_FILL 0
+#define RAMP_VERTICES 1
+#define RAMP_DONE 2
+
+/*
+ * The ramp first searches the highest number of quad layers which can be
+ * drawn without missing VSync, then does the same for triangles. Each
+ * search doubles the load until a level fails, then bisects between the
+ * last good and the first bad level.
+ */
+static struct {
+    u32 mode;
+    int stage;
+    u16 level;
+    u16 good;
+    u16 bad; /* 0 until a failing level has been found */
+    f32 good_fps;
+    u32 frames;
+    u32 missed;
+    u64 start;
+
+    u16 max_layers;
+    f32 layers_fps;
+    u16 max_ktriangles;
+    f32 ktriangles_fps;
+} ramp;
+
+static void start_stage(int stage)
+{
+    ramp.stage = stage;
+    ramp.level = 1;
+    ramp.good = 0;
+    ramp.bad = 0;
+    ramp.good_fps = 0;
+    ramp.frames = 0;
+    ramp.missed = 0;
+}
+
+void stress_reset(void)
+{
+    start_stage(RAMP_FILL);
+    ramp.max_layers = 0;
+    ramp.layers_fps = 0;
+    ramp.max_ktriangles = 0;
+    ramp.ktriangles_fps = 0;
+}
+
+/* Discards the measurement of the current level, which is then repeated */
+void stress_restart_level(void)
+{
+    ramp.frames = 0;
+    ramp.missed = 0;
+}
+
+static void finish_stage()
+{
+    if (ramp.stage == RAMP_FILL) {
+        ramp.max_layers = ramp.good;
+        ramp.layers_fps = ramp.good_fps;
+        start_stage(RAMP_VERTICES);
+    } else {
+        ramp.max_ktriangles = ramp.good;
+        ramp.ktriangles_fps = ramp.good_fps;
+        start_stage(RAMP_DONE);
+    }
+}
+
+static void next_level(bool passed, f32 fps)
+{
+    u16 limit = ramp.stage == RAMP_FILL ? MAX_LAYERS : MAX_KTRIANGLES;
+
+    if (passed) {
+        ramp.good = ramp.level;
+        ramp.good_fps = fps;
+    } else {
+        ramp.bad = ramp.level;
+    }
+
+    if (ramp.bad == 0) {
+        ramp.level = ramp.good * 2;
+        if (ramp.level > limit) {
+            finish_stage();
+            return;
+        }
+    } else {
+        ramp.level = (ramp.good + ramp.bad) / 2;
+        if (ramp.level == ramp.good) {
+            finish_stage();
+            return;
+        }
+    }
+    ramp.frames = 0;
+    ramp.missed = 0;
+}
+
+static void draw_layers(u16 layers, u16 w, u16 h)
+{
+    for (int i = 0; i < layers; i++) {
+        /* Alternate colours so that every layer changes the blended result */
+        u32 color = (i & 1) ? 0xff000020 : 0x0000ff20;
+
+        GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+        GX_Position2s16(0, 0);
+        GX_Color1u32(color);
+        GX_Position2s16(w, 0);
+        GX_Color1u32(color);
+        GX_Position2s16(w, h);
+        GX_Color1u32(color);
+        GX_Position2s16(0, h);
+        GX_Color1u32(color);
+        GX_End();
+    }
+}
+
+static void draw_triangles(u32 count, u16 w, u16 h)
+{
+    u32 columns = w / TRIANGLE_SIZE;
+    u32 cells = columns * (h / TRIANGLE_SIZE);
+    u32 n = 0;
+
+    if (cells == 0) return;
+
+    while (n < count) {
+        u32 batch = count - n;
+        if (batch > TRIANGLES_PER_BATCH) batch = TRIANGLES_PER_BATCH;
+
+        GX_Begin(GX_TRIANGLES, GX_VTXFMT0, batch * 3);
+        for (u32 i = 0; i < batch; i++, n++) {
+            u32 cell = n % cells;
+            s16 x = (cell % columns) * TRIANGLE_SIZE;
+            s16 y = (cell / columns) * TRIANGLE_SIZE;
+
+            GX_Position2s16(x, y);
+            GX_Color1u32(0x00ff0040);
+            GX_Position2s16(x + TRIANGLE_SIZE, y);
+            GX_Color1u32(0x00ff0040);
+            GX_Position2s16(x, y + TRIANGLE_SIZE);
+            GX_Color1u32(0x00ff0040);
+        }
+        GX_End();
+    }
+}
+
+/* The values are edited with wrap-around, so they can be huge */
+static void fixed_load(const struct stress_config *config,
+                       u16 *layers, u16 *ktriangles)
+{
+    *layers = config->layers < MAX_LAYERS ? config->layers : MAX_LAYERS;
+    *ktriangles = config->ktriangles < MAX_KTRIANGLES ?
+        config->ktriangles : MAX_KTRIANGLES;
+}
+
+/* Must be called with the geometry drawing state active */
+void stress_draw(const struct stress_config *config, u16 width, u16 height)
+{
+    u16 layers = 0, ktriangles = 0;
+
+    if (config->mode != ramp.mode) {
+        ramp.mode = config->mode;
+        stress_reset();
+    }
+
+    if (config->mode == STRESS_FIXED) {
+        fixed_load(config, &layers, &ktriangles);
+    } else if (config->mode == STRESS_RAMP) {
+        if (ramp.stage == RAMP_FILL) layers = ramp.level;
+        else if (ramp.stage == RAMP_VERTICES) ktriangles = ramp.level;
+    }
+    if (layers == 0 && ktriangles == 0) return;
+
+    trace_begin(TRACE_STRESS);
+    draw_layers(layers, width, height);
+    draw_triangles(ktriangles * 1000, width, height);
+    GX_SetDrawSync(TRACE_STRESS);
+    trace_end(TRACE_STRESS);
+}
+
+/* retraces is the number of VI retraces elapsed since the previous frame */
+void stress_frame_done(const struct stress_config *config, u32 retraces)
+{
+    if (config->mode != STRESS_RAMP || ramp.stage == RAMP_DONE) return;
+
+    ramp.frames++;
+    if (ramp.frames <= WARMUP_FRAMES) {
+        /* Let the previous level drain from the pipeline */
+        ramp.start = gettime();
+        return;
+    }
+
+    if (retraces > 1) ramp.missed++;
+
+    if (ramp.missed >= MAX_MISSED) {
+        next_level(false, 0);
+    } else if (ramp.frames >= WARMUP_FRAMES + HOLD_FRAMES) {
+        u32 elapsed_us = diff_usec(ramp.start, gettime());
+        f32 fps = elapsed_us ? HOLD_FRAMES * 1000000.0f / elapsed_us : 0;
+        next_level(ramp.missed == 0, fps);
+    }
+}
+
+void stress_format_status(char *buffer, const struct stress_config *config,
+                          u16 width, u16 height)
+{
+    if (config->mode == STRESS_FIXED) {
+        u16 layers, ktriangles;
+
+        fixed_load(config, &layers, &ktriangles);
+        sprintf(buffer, "Load: %u layers, %u triangles",
+                layers, ktriangles * 1000);
+    } else if (config->mode == STRESS_RAMP && ramp.stage == RAMP_FILL) {
+        sprintf(buffer, "Ramping fill: %u layers (%u Mpix/frame)", ramp.level,
+                ramp.level * width * height / 1000000);
+    } else if (config->mode == STRESS_RAMP && ramp.stage == RAMP_VERTICES) {
+        sprintf(buffer, "Ramping vertices: %u triangles", ramp.level * 1000);
+    } else if (config->mode == STRESS_RAMP) {
+        strcpy(buffer, "Ramp complete");
+    } else {
+        buffer[0] = '\0';
+    }
+}
+
+void stress_format_result(char *buffer, u16 width, u16 height)
+{
+    f32 fill_rate = ramp.max_layers * width * height * ramp.layers_fps / 1e6;
+
+    if (ramp.stage != RAMP_DONE) {
+        buffer[0] = '\0';
+        return;
+    }
+    sprintf(buffer, "Max %u layers = %.1f Mpix/s, %u verts/frame @ %.1f fps",
+            ramp.max_layers, fill_rate, ramp.max_ktriangles * 3000,
+            ramp.ktriangles_fps);
+}
@@ -0,0 +1,24 @@
+#ifndef WII_SCREEN_STRESS_H
+#define WII_SCREEN_STRESS_H
+
+#include <gccore.h>
+
+#define STRESS_OFF 0
+#define STRESS_FIXED 1
+#define STRESS_RAMP 2
+
+struct stress_config {
+    u32 mode;
+    u16 layers; /* full-screen blended quads */
+    u16 ktriangles; /* thousands of small triangles */
+};
+
+void stress_reset(void);
+void stress_restart_level(void);
+void stress_draw(const struct stress_config *config, u16 width, u16 height);
+void stress_frame_done(const struct stress_config *config, u32 retraces);
+void stress_format_status(char *buffer, const struct stress_config *config,
+                          u16 width, u16 height);
+void stress_format_result(char *buffer, u16 width, u16 height);
+
+#endif
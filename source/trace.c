@@ -0,0 +1,130 @@
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+#include <ogc/machine/processor.h>
+
+#include "trace.h"
+
+/* Must be a power of two; 16 bytes each */
+#define TRACE_RING_SIZE 16384
+
+static struct trace_event *ring = NULL;
+static u32 ring_head = 0;
+static int next_file_index = 0;
+
+static void retrace_callback(u32 retrace_count)
+{
+    trace_instant(TRACE_VI_RETRACE, retrace_count);
+}
+
+static void draw_sync_callback(u16 token)
+{
+    trace_instant(TRACE_GX_TOKEN, token);
+}
+
+static void draw_done_callback()
+{
+    trace_instant(TRACE_GX_DRAW_DONE, 0);
+}
+
+/* Must be called after GX_Init(), since it installs the GX callbacks.
+ * Flushing needs the SD card to be mounted by the caller. */
+void trace_init(void)
+{
+    ring = memalign(32, TRACE_RING_SIZE * sizeof(struct trace_event));
+    if (!ring) return;
+    memset(ring, 0, TRACE_RING_SIZE * sizeof(struct trace_event));
+    ring_head = 0;
+
+    VIDEO_SetPostRetraceCallback(retrace_callback);
+    GX_SetDrawSyncCallback(draw_sync_callback);
+    GX_SetDrawDoneCallback(draw_done_callback);
+}
+
+/* Safe to call from interrupt handlers */
+void trace_record(u16 id, u8 phase, u32 arg)
+{
+    struct trace_event *event;
+    u64 now;
+    u32 level;
+
+    if (!ring) return;
+
+    _CPU_ISR_Disable(level);
+    now = gettime();
+    event = &ring[ring_head & (TRACE_RING_SIZE - 1)];
+    ring_head++;
+    _CPU_ISR_Restore(level);
+
+    event->time_hi = now >> 32;
+    event->time_lo = now;
+    event->id = id;
+    event->phase = phase;
+    event->pad = 0;
+    event->arg = arg;
+}
+
+/* Picks the first unused file name, so that earlier traces are kept */
+static FILE *create_trace_file()
+{
+    char path[64];
+    FILE *file;
+
+    for (; next_file_index < TRACE_MAX_FILES; next_file_index++) {
+        sprintf(path, TRACE_FILE_FORMAT, next_file_index);
+        file = fopen(path, "rb");
+        if (file) {
+            fclose(file);
+            continue;
+        }
+        return fopen(path, "wb");
+    }
+    return NULL;
+}
+
+/* Writes the ring contents, oldest first, to a new file and empties the
+ * ring. Returns the index of the file, or -1 on error, in which case the
+ * ring is kept. */
+int trace_flush(void)
+{
+    struct trace_header header;
+    u32 head, count, start, first;
+    FILE *file;
+    int ret = -1;
+
+    if (!ring) return -1;
+
+    head = ring_head;
+    count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+    start = head - count;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.ticks_per_sec = TB_TIMER_CLOCK * 1000;
+    header.num_events = count;
+    header.dropped = head - count;
+
+    file = create_trace_file();
+    if (!file) goto out;
+
+    /* The records are stored in at most two contiguous runs */
+    start &= TRACE_RING_SIZE - 1;
+    first = TRACE_RING_SIZE - start;
+    if (first > count) first = count;
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1) goto out_close;
+    if (fwrite(ring + start, sizeof(*ring), first, file) != first) goto out_close;
+    if (fwrite(ring, sizeof(*ring), count - first, file) != count - first)
+        goto out_close;
+    ret = next_file_index++;
+    /* Events recorded while writing are discarded with the rest */
+    ring_head = 0;
+
+out_close:
+    fclose(file);
+out:
+    return ret;
+}
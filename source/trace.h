@@ -0,0 +1,30 @@
+#ifndef WII_SCREEN_TRACE_H
+#define WII_SCREEN_TRACE_H
+
+#include <gccore.h>
+
+#include "trace_format.h"
+
+#define TRACE_FILE_FORMAT "sd:/wii-screen-trace-%d.bin"
+#define TRACE_MAX_FILES 1000
+
+void trace_init(void);
+void trace_record(u16 id, u8 phase, u32 arg);
+int trace_flush(void);
+
+static inline void trace_begin(u16 id)
+{
+    trace_record(id, TRACE_PHASE_BEGIN, 0);
+}
+
+static inline void trace_end(u16 id)
+{
+    trace_record(id, TRACE_PHASE_END, 0);
+}
+
+static inline void trace_instant(u16 id, u32 arg)
+{
+    trace_record(id, TRACE_PHASE_INSTANT, arg);
+}
+
+#endif
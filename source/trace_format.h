@@ -0,0 +1,73 @@
+#ifndef WII_SCREEN_TRACE_FORMAT_H
+#define WII_SCREEN_TRACE_FORMAT_H
+
+/*
+ * On-disk layout of the event trace. This header is shared between the
+ * console program and the host-side tools, so it must only depend on the
+ * standard C headers. All fields are stored big-endian (the console's native
+ * byte order); readers on other hosts must swap them.
+ */
+
+#include <stdint.h>
+
+#define TRACE_MAGIC 0x57535452 /* "WSTR" */
+#define TRACE_VERSION 1
+
+#define TRACE_PHASE_BEGIN 'B'
+#define TRACE_PHASE_END 'E'
+#define TRACE_PHASE_INSTANT 'i'
+
+/* Timeline the event is shown on */
+#define TRACE_TRACK_MAIN 1
+#define TRACE_TRACK_VI 2
+#define TRACE_TRACK_GX 3
+
+/* X(id, name, track) */
+#define TRACE_EVENTS(X) \
+    X(FRAME, "frame", TRACE_TRACK_MAIN) \
+    X(INPUT, "input", TRACE_TRACK_MAIN) \
+    X(DRAW_BACKGROUND, "draw_background", TRACE_TRACK_MAIN) \
+    X(DRAW_TEXT, "draw_text", TRACE_TRACK_MAIN) \
+    X(DRAW_DONE, "GX_DrawDone", TRACE_TRACK_MAIN) \
+    X(COPY_DISP, "GX_CopyDisp", TRACE_TRACK_MAIN) \
+    X(WAIT_VSYNC, "VIDEO_WaitVSync", TRACE_TRACK_MAIN) \
+    X(APPLY_SETTINGS, "apply_settings", TRACE_TRACK_MAIN) \
+    X(VIDEO_CONFIGURE, "VIDEO_Configure", TRACE_TRACK_MAIN) \
+    X(VIDEO_FLUSH, "VIDEO_Flush", TRACE_TRACK_MAIN) \
+    X(SETTLE_VSYNC, "settle_vsync", TRACE_TRACK_MAIN) \
+    X(SETUP_VIEWPORT, "setup_viewport", TRACE_TRACK_MAIN) \
+    X(VI_RETRACE, "vi_retrace", TRACE_TRACK_VI) \
+    X(GX_TOKEN, "gx_token", TRACE_TRACK_GX) \
+    X(GX_DRAW_DONE, "gx_draw_done", TRACE_TRACK_GX) \
+    X(STRESS, "stress_load", TRACE_TRACK_MAIN) \
+    X(XFB_PATTERN, "xfb_draw_pattern", TRACE_TRACK_MAIN) \
+    X(FIELD, "next_field", TRACE_TRACK_VI) \
+    X(BENCHMARK, "benchmark_gx", TRACE_TRACK_MAIN)
+
+#define TRACE_ENUM(id, name, track) TRACE_##id,
+enum {
+    TRACE_EVENTS(TRACE_ENUM)
+    TRACE_NUM_EVENTS
+};
+#undef TRACE_ENUM
+
+struct trace_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ticks_per_sec;
+    uint32_t num_events; /* records following this header */
+    uint32_t dropped; /* records overwritten before the flush */
+    uint32_t reserved[3];
+};
+
+/* 16 bytes per record */
+struct trace_event {
+    uint32_t time_hi;
+    uint32_t time_lo;
+    uint16_t id;
+    uint8_t phase;
+    uint8_t pad;
+    uint32_t arg;
+};
+
+#endif
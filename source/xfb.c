@@ -0,0 +1,104 @@
+#include <gccore.h>
+
+#include "xfb.h"
+
+/*
+ * Test patterns written directly into the external framebuffer by the CPU,
+ * bypassing GX and the copy filters. The XFB stores two pixels in each
+ * 32-bit word; rows are padded to a multiple of 16 pixels, which makes every
+ * row start on a 32-byte cache line.
+ */
+
+static u32 fill_pair[2] ATTRIBUTE_ALIGN(8);
+
+/*
+ * Paired-single stores move 8 bytes at a time, but they go through the FPU:
+ * only words which are normal single-precision numbers are guaranteed to be
+ * stored back bit-exact.
+ */
+#define IS_PS_SAFE(value) \
+    ((((value) >> 23) & 0xff) != 0 && (((value) >> 23) & 0xff) != 0xff)
+
+_Static_assert(IS_PS_SAFE(XFB_BLACK), "XFB_BLACK is not a normal float");
+
+/* dst must be cached and 32-byte aligned; value must be IS_PS_SAFE() */
+static void fill_lines_ps(void *dst, u32 lines, u32 value)
+{
+    if (lines == 0) return;
+
+    fill_pair[0] = fill_pair[1] = value;
+    /* dcbz allocates each line in the cache without reading it from memory;
+     * all of it is then overwritten by four 8-byte stores. GQR0 is set up by
+     * the runtime for unscaled floats. */
+    __asm__ __volatile__ (
+        "psq_l 0, 0(%[pair]), 0, 0\n"
+        "mtctr %[lines]\n"
+        "1:\n"
+        "dcbz 0, %[dst]\n"
+        "psq_st 0, 0(%[dst]), 0, 0\n"
+        "psq_st 0, 8(%[dst]), 0, 0\n"
+        "psq_st 0, 16(%[dst]), 0, 0\n"
+        "psq_st 0, 24(%[dst]), 0, 0\n"
+        "addi %[dst], %[dst], 32\n"
+        "bdnz 1b\n"
+        : [dst] "+b" (dst)
+        : [pair] "b" (fill_pair), [lines] "r" (lines)
+        : "fr0", "ctr", "memory");
+}
+
+static void fill_words(u32 *dst, u32 words, u32 value)
+{
+    while (words--) *dst++ = value;
+}
+
+static inline void set_luma(u8 *row, u32 x, u8 y)
+{
+    row[(x / 2) * 4 + (x & 1) * 2] = y;
+}
+
+static void draw_grid(u8 *fb, u32 stride, u32 w, u32 h)
+{
+    for (u32 y = 0; y < h; y++) {
+        u8 *row = fb + y * stride;
+
+        if (y % 16 == 0 || y == h - 1) {
+            for (u32 x = 0; x < w; x++) set_luma(row, x, XFB_GRID_Y);
+            continue;
+        }
+        for (u32 x = 0; x < w; x += 16) set_luma(row, x, XFB_GRID_Y);
+        set_luma(row, w - 1, XFB_GRID_Y);
+
+        // Diagonal lines
+        set_luma(row, y * w / h, XFB_GRID_Y);
+        set_luma(row, w - 1 - y * w / h, XFB_GRID_Y);
+    }
+}
+
+/*
+ * The mode may be anything the user typed in, so only the rows which fit
+ * in the xfb_size bytes of the framebuffer are drawn.
+ */
+void xfb_draw_pattern(void *xfb, u32 xfb_size, const GXRModeObj *mode,
+                      bool paired_single)
+{
+    u32 w = mode->fbWidth;
+    u32 h = mode->xfbHeight;
+    u32 stride = VIDEO_PadFramebufferWidth(w) * 2;
+    u32 size;
+    u8 *fb = MEM_K1_TO_K0(xfb);
+
+    if (w == 0 || h == 0 || stride > xfb_size) return;
+    if (h > xfb_size / stride) h = xfb_size / stride;
+    size = stride * h;
+
+    /* Only the clear differs between the two paths; the grid is drawn
+     * byte by byte in both */
+    if (paired_single) {
+        fill_lines_ps(fb, size / 32, XFB_BLACK);
+    } else {
+        fill_words((u32 *)fb, size / 4, XFB_BLACK);
+    }
+    draw_grid(fb, stride, w, h);
+
+    DCFlushRange(fb, size);
+}
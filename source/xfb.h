@@ -0,0 +1,17 @@
+#ifndef WII_SCREEN_XFB_H
+#define WII_SCREEN_XFB_H
+
+#include <gccore.h>
+
+/* YUV422 (Y0 U Y1 V) values for two identical pixels */
+#define XFB_BLACK 0x10801080
+#define XFB_GRID_Y 0x47
+
+/* The framebuffers are allocated for the largest mode */
+#define XFB_MAX_WIDTH 640
+#define XFB_MAX_HEIGHT 576
+
+void xfb_draw_pattern(void *xfb, u32 xfb_size, const GXRModeObj *mode,
+                      bool paired_single);
+
+#endif
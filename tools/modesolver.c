@@ -0,0 +1,391 @@
+/*
+ * Searches the GXRModeObj parameter space for the modes which best display
+ * a picture of the given aspect ratio over the given active area, and
+ * prints them as presets which wii-screen loads from its presets file.
+ *
+ * Usage: modesolver -w <width> -H <lines> [options] > wii-screen-presets.txt
+ *
+ * Copy the output to the root of the SD card, where wii-screen reads it as
+ * sd:/wii-screen-presets.txt. Its '#' lines are comments.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "modeutil.h"
+
+#define MAX_RESULTS 100
+
+/* Width of the 4:3 picture area in VI pixels, per ITU-R BT.601 */
+#define NOMINAL_ACTIVE_WIDTH 704
+
+struct options {
+    u32 standard;
+    u32 scan;
+    u16 width;
+    u16 height;
+    double aspect;
+    double display_aspect;
+    double tolerance;
+    int jobs;
+    int results;
+};
+
+struct candidate {
+    double score;
+    GXRModeObj mode;
+};
+
+struct job {
+    const struct options *options;
+    u16 vi_width_min, vi_width_max;
+    u16 vi_height_min, vi_height_max;
+    pthread_mutex_t *lock;
+    u16 *next_vi_width;
+    struct candidate best[MAX_RESULTS];
+    int num_best;
+    unsigned long long evaluated;
+    unsigned long long valid;
+};
+
+static const struct {
+    const char *name;
+    u32 standard;
+} standards[] = {
+    { "ntsc", VI_NTSC },
+    { "pal", VI_PAL },
+    { "mpal", VI_MPAL },
+    { "eurgb60", VI_EURGB60 },
+};
+#define NUM_STANDARDS (sizeof(standards) / sizeof(standards[0]))
+
+static const struct {
+    const char *name;
+    u32 scan;
+} scans[] = {
+    { "int", VI_INTERLACE },
+    { "ds", VI_NON_INTERLACE },
+    { "prog", VI_PROGRESSIVE },
+};
+#define NUM_SCANS (sizeof(scans) / sizeof(scans[0]))
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s -w <width> -H <lines> [options]\n"
+            "  -w <width>     target active width, in VI pixels\n"
+            "  -H <lines>     target active height, in lines\n"
+            "  -a <w:h>       aspect ratio of the picture (default: that of the\n"
+            "                 active area on the display)\n"
+            "  -d <w:h>       aspect ratio of the display (default 4:3)\n"
+            "  -s <standard>  ntsc, pal, mpal or eurgb60 (default ntsc)\n"
+            "  -m <scan>      int, ds or prog (default int)\n"
+            "  -t <percent>   allowed deviation from the active area (default 5)\n"
+            "  -n <count>     number of presets to print (default 10)\n"
+            "  -j <jobs>      worker threads (default: number of CPUs)\n"
+            "The presets are printed to stdout; save them as\n"
+            "wii-screen-presets.txt in the root of the SD card:\n"
+            "  %s -w 640 -H 480 > wii-screen-presets.txt\n",
+            program, program);
+}
+
+static int parse_ratio(const char *text, double *ratio)
+{
+    double w, h;
+
+    if (sscanf(text, "%lf:%lf", &w, &h) != 2 || w <= 0 || h <= 0) return -1;
+    *ratio = w / h;
+    return 0;
+}
+
+/* Width/height ratio of a VI pixel, on a display of the given aspect */
+static double vi_pixel_aspect(const struct options *options)
+{
+    u32 tvmode = VI_TVMODE(options->standard, VI_INTERLACE);
+    double lines = mode_max_height(tvmode);
+
+    return options->display_aspect * lines / NOMINAL_ACTIVE_WIDTH;
+}
+
+static int parse_options(int argc, char **argv, struct options *options)
+{
+    int opt;
+
+    memset(options, 0, sizeof(*options));
+    options->standard = VI_NTSC;
+    options->scan = VI_INTERLACE;
+    options->display_aspect = 4.0 / 3.0;
+    options->tolerance = 5;
+    options->jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    options->results = 10;
+
+    while ((opt = getopt(argc, argv, "w:H:a:d:s:m:t:n:j:h")) != -1) {
+        int i;
+
+        switch (opt) {
+        case 'w':
+            options->width = atoi(optarg);
+            break;
+        case 'H':
+            options->height = atoi(optarg);
+            break;
+        case 'a':
+            if (parse_ratio(optarg, &options->aspect) < 0) return -1;
+            break;
+        case 'd':
+            if (parse_ratio(optarg, &options->display_aspect) < 0) return -1;
+            break;
+        case 's':
+            for (i = 0; i < NUM_STANDARDS; i++) {
+                if (strcmp(optarg, standards[i].name) == 0) break;
+            }
+            if (i == NUM_STANDARDS) return -1;
+            options->standard = standards[i].standard;
+            break;
+        case 'm':
+            for (i = 0; i < NUM_SCANS; i++) {
+                if (strcmp(optarg, scans[i].name) == 0) break;
+            }
+            if (i == NUM_SCANS) return -1;
+            options->scan = scans[i].scan;
+            break;
+        case 't':
+            options->tolerance = atof(optarg);
+            break;
+        case 'n':
+            options->results = atoi(optarg);
+            break;
+        case 'j':
+            options->jobs = atoi(optarg);
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    if (options->width == 0 || options->height == 0) return -1;
+    if (options->tolerance < 0) return -1;
+    if (options->aspect == 0) {
+        /* Keep the shape of the requested area */
+        options->aspect = vi_pixel_aspect(options) * options->width / options->height;
+    }
+    if (options->results < 1) options->results = 1;
+    if (options->results > MAX_RESULTS) options->results = MAX_RESULTS;
+    if (options->jobs < 1) options->jobs = 1;
+    return 0;
+}
+
+/*
+ * Weights of the ranking terms. The area term costs 1 per relative
+ * deviation from the target width or height and the aspect term 1 per unit
+ * of log(picture aspect / target aspect), so a 5% error in either costs
+ * about 0.05. Upscaling is charged per unit of log(scale factor): a 704/640
+ * horizontal stretch costs about 0.05 and a 2x line doubling about 0.35, so
+ * a mode close to the target area is preferred to a low-resolution one
+ * which matches it exactly. A non-integer EFB to XFB copy also pays a flat
+ * penalty, because it blurs lines unevenly.
+ */
+#define WEIGHT_AREA 1.0
+#define WEIGHT_ASPECT 1.0
+#define WEIGHT_H_UPSCALE 0.5
+#define WEIGHT_V_UPSCALE 0.5
+#define PENALTY_Y_SCALE 0.05
+#define WEIGHT_RESOLUTION 1e-4
+
+/*
+ * Lower is better. Combines how far the mode is from the requested active
+ * area and picture aspect with how much resolution is lost on the way to
+ * the screen: VI pixels per FB pixel, and VI lines per EFB line beyond what
+ * the scan type needs (non-interlaced modes always double their lines).
+ */
+static double score_mode(const GXRModeObj *mode, const struct options *options,
+                         double par)
+{
+    double picture_aspect = mode->viWidth * par / mode->viHeight;
+    double native_lines = options->scan == VI_NON_INTERLACE ? 2 : 1;
+    double h_upscale = (double)mode->viWidth / mode->fbWidth;
+    double v_upscale = (double)mode->viHeight / mode->efbHeight / native_lines;
+    double score = 0;
+
+    score += WEIGHT_AREA * fabs(mode->viWidth - options->width) / options->width;
+    score += WEIGHT_AREA * fabs(mode->viHeight - options->height) / options->height;
+    score += WEIGHT_ASPECT * fabs(log(picture_aspect / options->aspect));
+    score += WEIGHT_H_UPSCALE * log(h_upscale);
+    score += WEIGHT_V_UPSCALE * log(v_upscale);
+    if (mode->xfbHeight % mode->efbHeight != 0) score += PENALTY_Y_SCALE;
+    /* Among otherwise equal modes, prefer the sharper one */
+    score += WEIGHT_RESOLUTION * (1 - (double)mode->fbWidth * mode->efbHeight /
+                                  (MODE_FB_MAX_WIDTH * MODE_EFB_MAX_HEIGHT));
+    return score;
+}
+
+/* Breaks ties on the mode itself, so that the output does not depend on
+ * the order in which the threads finish */
+static int compare_candidates(double score_a, const GXRModeObj *a,
+                              double score_b, const GXRModeObj *b)
+{
+    if (score_a != score_b) return score_a < score_b ? -1 : 1;
+    return memcmp(a, b, sizeof(GXRModeObj));
+}
+
+static void add_candidate(struct job *job, const GXRModeObj *mode, double score)
+{
+    int limit = job->options->results;
+    int i;
+
+    if (job->num_best == limit &&
+        compare_candidates(score, mode, job->best[limit - 1].score,
+                           &job->best[limit - 1].mode) >= 0) return;
+
+    i = job->num_best < limit ? job->num_best++ : limit - 1;
+    for (; i > 0 && compare_candidates(job->best[i - 1].score,
+                                       &job->best[i - 1].mode,
+                                       score, mode) > 0; i--) {
+        job->best[i] = job->best[i - 1];
+    }
+    job->best[i].score = score;
+    job->best[i].mode = *mode;
+}
+
+static void search_width(struct job *job, u16 vi_width, double par)
+{
+    const struct options *options = job->options;
+    GXRModeObj mode;
+
+    memset(&mode, 0, sizeof(mode));
+    mode.viTVMode = VI_TVMODE(options->standard, options->scan);
+    mode.viWidth = vi_width;
+
+    for (u16 vi_height = job->vi_height_min; vi_height <= job->vi_height_max;
+         vi_height += 2) {
+        mode.viHeight = vi_height;
+        mode_center(&mode);
+
+        for (u32 xfb_mode = VI_XFBMODE_SF; xfb_mode <= VI_XFBMODE_DF; xfb_mode++) {
+            mode.xfbMode = xfb_mode;
+            if (xfb_mode == VI_XFBMODE_DF || options->scan == VI_PROGRESSIVE) {
+                mode.xfbHeight = vi_height;
+            } else {
+                mode.xfbHeight = vi_height / 2;
+            }
+
+            for (u16 fb_width = 16; fb_width <= MODE_FB_MAX_WIDTH; fb_width += 16) {
+                mode.fbWidth = fb_width;
+
+                for (u16 efb_height = 1; efb_height <= mode.xfbHeight &&
+                     efb_height <= MODE_EFB_MAX_HEIGHT; efb_height++) {
+                    mode.efbHeight = efb_height;
+                    job->evaluated++;
+
+                    if (mode_check(&mode) != NULL) continue;
+                    job->valid++;
+                    add_candidate(job, &mode, score_mode(&mode, options, par));
+                }
+            }
+        }
+    }
+}
+
+static void *worker(void *data)
+{
+    struct job *job = data;
+    double par = vi_pixel_aspect(job->options);
+
+    while (1) {
+        u16 vi_width;
+
+        pthread_mutex_lock(job->lock);
+        vi_width = *job->next_vi_width;
+        *job->next_vi_width += 2;
+        pthread_mutex_unlock(job->lock);
+
+        if (vi_width > job->vi_width_max) break;
+        search_width(job, vi_width, par);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    struct options options;
+    struct job *jobs, merged;
+    pthread_t *threads;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    u32 tvmode;
+    u16 next_vi_width;
+    int w_min, w_max, h_min, h_max;
+
+    if (parse_options(argc, argv, &options) < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    tvmode = VI_TVMODE(options.standard, options.scan);
+    w_min = options.width * (1 - options.tolerance / 100);
+    w_max = options.width * (1 + options.tolerance / 100);
+    h_min = options.height * (1 - options.tolerance / 100);
+    h_max = options.height * (1 + options.tolerance / 100);
+    if (w_min < 2) w_min = 2;
+    if (w_max > mode_max_width(tvmode)) w_max = mode_max_width(tvmode);
+    if (h_min < 2) h_min = 2;
+    if (h_max > mode_max_height(tvmode)) h_max = mode_max_height(tvmode);
+    if (w_min > w_max || h_min > h_max) {
+        fprintf(stderr, "The active area does not fit this TV standard\n");
+        return EXIT_FAILURE;
+    }
+
+    jobs = calloc(options.jobs, sizeof(*jobs));
+    threads = calloc(options.jobs, sizeof(*threads));
+    if (!jobs || !threads) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    next_vi_width = w_min + (w_min & 1);
+    for (int i = 0; i < options.jobs; i++) {
+        jobs[i].options = &options;
+        jobs[i].vi_width_min = w_min;
+        jobs[i].vi_width_max = w_max;
+        jobs[i].vi_height_min = h_min + (h_min & 1);
+        jobs[i].vi_height_max = h_max;
+        jobs[i].lock = &lock;
+        jobs[i].next_vi_width = &next_vi_width;
+
+        errno = pthread_create(&threads[i], NULL, worker, &jobs[i]);
+        if (errno != 0) {
+            perror("pthread_create");
+            return EXIT_FAILURE;
+        }
+    }
+
+    memset(&merged, 0, sizeof(merged));
+    merged.options = &options;
+    for (int i = 0; i < options.jobs; i++) {
+        pthread_join(threads[i], NULL);
+        for (int j = 0; j < jobs[i].num_best; j++) {
+            add_candidate(&merged, &jobs[i].best[j].mode, jobs[i].best[j].score);
+        }
+        merged.evaluated += jobs[i].evaluated;
+        merged.valid += jobs[i].valid;
+    }
+
+    printf("# %llu combinations, %llu valid\n", merged.evaluated, merged.valid);
+    for (int i = 0; i < merged.num_best; i++) {
+        char name[MODE_PRESET_NAME_SIZE];
+        char buffer[256];
+
+        snprintf(name, sizeof(name), "solver-%dx%d-%d",
+                 options.width, options.height, i + 1);
+        mode_format_preset(buffer, sizeof(buffer), name, &merged.best[i].mode);
+        printf("# score %.6f\n%s", merged.best[i].score, buffer);
+    }
+
+    free(jobs);
+    free(threads);
+    return merged.num_best > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,195 @@
+/*
+ * Converts a binary trace saved by wii-screen into the Chrome trace event
+ * JSON format, which can be loaded in chrome://tracing or ui.perfetto.dev.
+ *
+ * Usage: trace2json <trace.bin> [<output.json>]
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace_format.h"
+
+struct event_info {
+    const char *name;
+    int track;
+};
+
+#define TRACE_INFO(id, name, track) { name, track },
+static const struct event_info event_infos[] = {
+    TRACE_EVENTS(TRACE_INFO)
+};
+#undef TRACE_INFO
+
+static const char *track_names[] = {
+    [TRACE_TRACK_MAIN] = "main",
+    [TRACE_TRACK_VI] = "VI retrace",
+    [TRACE_TRACK_GX] = "GX",
+};
+
+static uint32_t read_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+        (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint16_t read_be16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static int read_header(FILE *in, struct trace_header *header)
+{
+    uint8_t buffer[sizeof(struct trace_header)];
+
+    if (fread(buffer, sizeof(buffer), 1, in) != 1) return -1;
+
+    header->magic = read_be32(buffer + offsetof(struct trace_header, magic));
+    header->version = read_be32(buffer + offsetof(struct trace_header, version));
+    header->ticks_per_sec =
+        read_be32(buffer + offsetof(struct trace_header, ticks_per_sec));
+    header->num_events =
+        read_be32(buffer + offsetof(struct trace_header, num_events));
+    header->dropped = read_be32(buffer + offsetof(struct trace_header, dropped));
+    return 0;
+}
+
+static int read_event(FILE *in, struct trace_event *event)
+{
+    uint8_t buffer[sizeof(struct trace_event)];
+
+    if (fread(buffer, sizeof(buffer), 1, in) != 1) return -1;
+
+    event->time_hi = read_be32(buffer + offsetof(struct trace_event, time_hi));
+    event->time_lo = read_be32(buffer + offsetof(struct trace_event, time_lo));
+    event->id = read_be16(buffer + offsetof(struct trace_event, id));
+    event->phase = buffer[offsetof(struct trace_event, phase)];
+    event->arg = read_be32(buffer + offsetof(struct trace_event, arg));
+    return 0;
+}
+
+static void write_metadata(FILE *out)
+{
+    for (int track = TRACE_TRACK_MAIN; track <= TRACE_TRACK_GX; track++) {
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+                track, track_names[track]);
+    }
+}
+
+static int write_event(FILE *out, const struct trace_event *event,
+                       double ts_us)
+{
+    const struct event_info *info;
+    const char *arg_name = NULL;
+
+    if (event->id >= TRACE_NUM_EVENTS) return -1;
+    if (event->phase != TRACE_PHASE_BEGIN &&
+        event->phase != TRACE_PHASE_END &&
+        event->phase != TRACE_PHASE_INSTANT) return -1;
+
+    info = &event_infos[event->id];
+    /* Only these events carry a value in arg */
+    if (event->id == TRACE_FRAME) arg_name = "frame";
+    else if (event->id == TRACE_VI_RETRACE) arg_name = "retrace";
+    else if (event->id == TRACE_FIELD) arg_name = "field";
+    else if (event->id == TRACE_GX_TOKEN) {
+        /* Tokens carry the id of the drawing phase they terminate */
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                "\"pid\":1,\"tid\":%d,\"args\":{\"phase\":\"%s\"}},\n",
+                info->name, ts_us, info->track,
+                event->arg < TRACE_NUM_EVENTS ?
+                    event_infos[event->arg].name : "unknown");
+        return 0;
+    }
+
+    fprintf(out, "{\"name\":\"%s\",\"ph\":\"%c\",", info->name, event->phase);
+    if (event->phase == TRACE_PHASE_INSTANT) fputs("\"s\":\"t\",", out);
+    fprintf(out, "\"ts\":%.3f,\"pid\":1,\"tid\":%d", ts_us, info->track);
+    if (arg_name) {
+        fprintf(out, ",\"args\":{\"%s\":%u}", arg_name, (unsigned)event->arg);
+    }
+    fputs("},\n", out);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct trace_header header;
+    struct trace_event event;
+    uint64_t first_time = 0;
+    uint32_t skipped = 0;
+    FILE *in, *out = stdout;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace.bin> [<output.json>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Cannot open %s: %s\n", argv[1], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (read_header(in, &header) < 0 || header.magic != TRACE_MAGIC) {
+        fprintf(stderr, "%s is not a wii-screen trace\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (header.version != TRACE_VERSION) {
+        fprintf(stderr, "Unsupported trace version %u\n",
+                (unsigned)header.version);
+        return EXIT_FAILURE;
+    }
+    if (header.ticks_per_sec == 0) {
+        fprintf(stderr, "Invalid timer frequency in trace header\n");
+        return EXIT_FAILURE;
+    }
+
+    if (argc == 3) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            fprintf(stderr, "Cannot create %s: %s\n", argv[2], strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+    write_metadata(out);
+
+    for (uint32_t i = 0; i < header.num_events; i++) {
+        uint64_t time;
+        double ts_us;
+
+        if (read_event(in, &event) < 0) {
+            fprintf(stderr, "Trace truncated after %u events\n", (unsigned)i);
+            break;
+        }
+
+        time = (uint64_t)event.time_hi << 32 | event.time_lo;
+        if (i == 0) first_time = time;
+        ts_us = (double)(time - first_time) * 1e6 / header.ticks_per_sec;
+
+        if (write_event(out, &event, ts_us) < 0) skipped++;
+    }
+
+    /* Closes the array without a trailing comma */
+    fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"wii-screen\"}}\n]}\n", out);
+
+    if (skipped > 0) {
+        fprintf(stderr, "Skipped %u malformed events\n", (unsigned)skipped);
+    }
+    if (header.dropped > 0) {
+        fprintf(stderr, "%u older events were overwritten on the console\n",
+                (unsigned)header.dropped);
+    }
+
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return EXIT_SUCCESS;
+}